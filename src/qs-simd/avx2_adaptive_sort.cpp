@@ -0,0 +1,421 @@
+#include <algorithm>
+#include <vector>
+
+
+namespace qs {
+
+    namespace avx2 {
+
+
+        // Largest value range for counting sort, bounds the memory of a histogram (64 MBytes).
+        const long long COUNTING_MAX_RANGE = 1 << 24;
+
+        // Upper limit for the entries of all histograms of the counting sort together (256 MBytes).
+        const long long COUNTING_MAX_ENTRIES = 1 << 26;
+
+
+        // Properties of an input estimated from a sample.
+        struct InputStats {
+            int         length;
+            uint32_t    min;                // Minimum of the sample
+            uint32_t    max;                // Maximum of the sample
+            double      approxDistinct;     // Estimated number of distinct values of the whole input
+            double      sortedness;         // Fraction of ascending (<) neighbours among the unequal ones in the sample
+            double      reverseness;        // Fraction of descending (>) neighbours among the unequal ones in the sample
+        };
+
+
+        // Implementations the adaptive sort can dispatch to.
+        enum SortAlgorithm {
+            SORT_ALREADY_SORTED,    // Linear check, nothing to do
+            SORT_REVERSE,           // Linear check and reversal
+            SORT_COUNTING,          // Counting sort for a small value range
+            SORT_COUNT_EXPAND,      // ompSortCount and expansion of the counts, for few distinct values
+            SORT_SIMD,              // qs::avx2::quicksort
+            SORT_SIMD_OMP           // qs::avx2::ompQuicksort
+        };
+
+
+        const char* sortAlgorithmName(SortAlgorithm algorithm) {
+            switch (algorithm) {
+                case SORT_ALREADY_SORTED:   return "already sorted";
+                case SORT_REVERSE:          return "reverse";
+                case SORT_COUNTING:         return "counting";
+                case SORT_COUNT_EXPAND:     return "sort count + expand";
+                case SORT_SIMD:             return "simd";
+                case SORT_SIMD_OMP:         return "omp simd";
+            }
+            return "unknown";
+        }
+
+
+        // Decision of the adaptive sort, can be logged by the caller.
+        struct SortDecision {
+            SortAlgorithm   algorithm;
+            int             numThreads;
+            InputStats      stats;
+        };
+
+
+        /*
+         *  Collects InputStats from evenly spread blocks of the input with SIMD.
+         *  Every block is scanned for minimum, maximum and ordered neighbours,
+         *  the number of distinct values is estimated from the sorted sample.
+         *
+         *  Params:
+         *  uint32_t*   array       -->     Input
+         *  int         lenArray    -->     Number of values
+         *
+         */
+        InputStats sample_stats_epi32(const uint32_t* array, int lenArray) {
+
+            // the number of items in a register (256/32)
+            const int N = 8;
+
+            // 64 blocks of 64 values, small enough to be cheap for every input size.
+            const int NUM_BLOCKS = 64;
+            const int BLOCK_SIZE = 64;
+
+            InputStats stats;
+            stats.length = lenArray;
+            stats.min = 0;
+            stats.max = 0;
+            stats.approxDistinct = lenArray;
+            stats.sortedness = 1.0;
+            stats.reverseness = 1.0;
+
+            if (lenArray < 2) {
+                return stats;
+            }
+
+            const int blockSize = std::min(BLOCK_SIZE, lenArray);
+            const int numBlocks = std::min(NUM_BLOCKS, lenArray / blockSize);
+
+            std::vector<uint32_t> sample;
+            sample.reserve(numBlocks * blockSize);
+
+            __m256i vmin = _mm256_set1_epi32(-1);
+            __m256i vmax = _mm256_setzero_si256();
+            // Equal neighbours are neither ascending nor descending, otherwise runs of equal values look sorted.
+            long long ascending  = 0;
+            long long descending = 0;
+
+            for (int b = 0; b < numBlocks; b++) {
+
+                const int start = (int)(((long long)b * (lenArray - blockSize)) / std::max(1, numBlocks - 1));
+                const uint32_t* block = array + start;
+                sample.insert(sample.end(), block, block + blockSize);
+
+                int k = 0;
+                for (; k + N < blockSize; k += N) {
+                    const __m256i v    = _mm256_loadu_si256((const __m256i*)(block + k));
+                    const __m256i next = _mm256_loadu_si256((const __m256i*)(block + k + 1));
+
+                    vmin = _mm256_min_epu32(vmin, v);
+                    vmax = _mm256_max_epu32(vmax, v);
+
+                    // v <= next (unsigned) if min(v, next) == v, v < next if additionally v != next
+                    const uint32_t le = _mm256_movemask_ps((__m256)_mm256_cmpeq_epi32(_mm256_min_epu32(v, next), v));
+                    const uint32_t ge = _mm256_movemask_ps((__m256)_mm256_cmpeq_epi32(_mm256_max_epu32(v, next), v));
+                    const uint32_t eq = _mm256_movemask_ps((__m256)_mm256_cmpeq_epi32(v, next));
+                    ascending  += _mm_popcnt_u32(le & ~eq);
+                    descending += _mm_popcnt_u32(ge & ~eq);
+                }
+
+                // Remaining values without SIMD
+                for (; k < blockSize; k++) {
+                    const __m256i v = _mm256_set1_epi32(block[k]);
+                    vmin = _mm256_min_epu32(vmin, v);
+                    vmax = _mm256_max_epu32(vmax, v);
+                    if (k + 1 < blockSize) {
+                        ascending  += int(block[k] < block[k + 1]);
+                        descending += int(block[k] > block[k + 1]);
+                    }
+                }
+            }
+
+            uint32_t __attribute__((__aligned__(32))) tmp[8];
+            _mm256_store_si256((__m256i*)tmp, vmin);
+            stats.min = *std::min_element(tmp, tmp + 8);
+            _mm256_store_si256((__m256i*)tmp, vmax);
+            stats.max = *std::max_element(tmp, tmp + 8);
+
+            // A sample of equal values is sorted in both directions.
+            const long long unequal = ascending + descending;
+            stats.sortedness  = unequal > 0 ? (double)ascending / unequal : 1.0;
+            stats.reverseness = unequal > 0 ? (double)descending / unequal : 1.0;
+
+            // Values seen once are scaled with n / sample size, values seen more often count once.
+            // Overestimates inputs with some duplicates, but reliably finds inputs with few distinct values.
+            std::sort(sample.begin(), sample.end());
+            long long once = 0;
+            long long more = 0;
+            for (int s = 0; s < (int)sample.size(); ) {
+                int e = s + 1;
+                while (e < (int)sample.size() && sample[e] == sample[s]) {
+                    e++;
+                }
+                if (e - s == 1) { once++; } else { more++; }
+                s = e;
+            }
+            stats.approxDistinct = std::min((double)lenArray, (double)lenArray / sample.size() * once + more);
+
+            return stats;
+        }
+
+
+        /*
+         *  Checks with SIMD if the array is sorted ascending.
+         *
+         */
+        bool is_sorted_epi32(const uint32_t* array, int lenArray) {
+
+            const int N = 8;
+
+            int k = 0;
+            for (; k + N < lenArray; k += N) {
+                const __m256i v    = _mm256_loadu_si256((const __m256i*)(array + k));
+                const __m256i next = _mm256_loadu_si256((const __m256i*)(array + k + 1));
+                if (!_mm256_testc_si256(_mm256_cmpeq_epi32(_mm256_min_epu32(v, next), v), _mm256_set1_epi32(-1))) {
+                    return false;
+                }
+            }
+
+            for (; k + 1 < lenArray; k++) {
+                if (array[k] > array[k + 1]) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+
+        /*
+         *  Calculates minimum and maximum of the array with SIMD.
+         *
+         */
+        void minmax_epi32(const uint32_t* array, int lenArray, uint32_t& minValue, uint32_t& maxValue) {
+
+            const int N = 8;
+
+            __m256i vmin = _mm256_set1_epi32(-1);
+            __m256i vmax = _mm256_setzero_si256();
+
+            int k = 0;
+            for (; k + N <= lenArray; k += N) {
+                const __m256i v = _mm256_loadu_si256((const __m256i*)(array + k));
+                vmin = _mm256_min_epu32(vmin, v);
+                vmax = _mm256_max_epu32(vmax, v);
+            }
+
+            uint32_t __attribute__((__aligned__(32))) tmp[8];
+            _mm256_store_si256((__m256i*)tmp, vmin);
+            minValue = *std::min_element(tmp, tmp + 8);
+            _mm256_store_si256((__m256i*)tmp, vmax);
+            maxValue = *std::max_element(tmp, tmp + 8);
+
+            for (; k < lenArray; k++) {
+                minValue = std::min(minValue, array[k]);
+                maxValue = std::max(maxValue, array[k]);
+            }
+        }
+
+
+        /*
+         *  Counting sort with a histogram per thread.
+         *
+         *  Params:
+         *  uint32_t*   array       -->     Array to sort
+         *  int         lenArray    -->     Number of values
+         *  uint32_t    minValue    -->     Lowest value of the array
+         *  uint32_t    maxValue    -->     Highest value of the array
+         *  int         numThreads  -->     Number of threads
+         *
+         */
+        void ompCountingSort(uint32_t* array, int lenArray, uint32_t minValue, uint32_t maxValue, int numThreads) {
+
+            const int range = (int)(maxValue - minValue) + 1;
+
+            std::vector<std::vector<int> > histograms(numThreads);
+
+            // Counting
+            #pragma omp parallel num_threads(numThreads)
+            {
+                std::vector<int>& histogram = histograms[omp_get_thread_num()];
+                histogram.assign(range, 0);
+
+                #pragma omp for schedule(static)
+                for (int k = 0; k < lenArray; k++) {
+                    histogram[array[k] - minValue]++;
+                }
+            }
+
+            // Sum up the histograms and calculate the start of every value
+            std::vector<int> starts(range + 1, 0);
+            for (int v = 0; v < range; v++) {
+                int count = 0;
+                for (int t = 0; t < (int)histograms.size(); t++) {
+                    if (!histograms[t].empty()) {
+                        count += histograms[t][v];
+                    }
+                }
+                starts[v + 1] = starts[v] + count;
+            }
+
+            // Writing
+            #pragma omp parallel for num_threads(numThreads) schedule(static)
+            for (int v = 0; v < range; v++) {
+                std::fill(array + starts[v], array + starts[v + 1], minValue + (uint32_t)v);
+            }
+        }
+
+
+        // Number of threads worth using for lenArray values.
+        int threads_for_length(int lenArray, int maxThreads) {
+
+            // Values per thread, below the management of threads costs more than it gains.
+            const int VALUES_PER_THREAD = 100000;
+
+            return std::max(1, std::min(maxThreads, lenArray / VALUES_PER_THREAD));
+        }
+
+
+        /*
+         *  Chooses the implementation for an input which is not sorted, from its value range and distinct values.
+         *  Used by chooseSort and by adaptiveSort when a guess turned out to be wrong.
+         *
+         *  Params:
+         *  SortDecision decision   -->     Stats and thread count of the input, receives the algorithm
+         *  bool        counting    -->     false if the counting sort is already known not to fit
+         *
+         */
+        void chooseUnsortedSort(SortDecision& decision, bool counting) {
+
+            const InputStats& stats = decision.stats;
+            const long long range = (long long)stats.max - stats.min + 1;
+
+            if (counting && range <= stats.length && range <= COUNTING_MAX_RANGE) {
+                decision.algorithm = SORT_COUNTING;
+                decision.numThreads = (int)std::max(1LL, std::min((long long)decision.numThreads, COUNTING_MAX_ENTRIES / range));
+            } else if (stats.approxDistinct * 16 <= stats.length) {
+                decision.algorithm = SORT_COUNT_EXPAND;
+            } else if (decision.numThreads == 1) {
+                decision.algorithm = SORT_SIMD;
+            } else {
+                decision.algorithm = SORT_SIMD_OMP;
+            }
+        }
+
+
+        /*
+         *  Chooses the implementation for the given input.
+         *
+         *  Params:
+         *  uint32_t*   array       -->     Input
+         *  int         lenArray    -->     Number of values
+         *  int         maxThreads  -->     Upper limit for the number of threads
+         *
+         */
+        SortDecision chooseSort(const uint32_t* array, int lenArray, int maxThreads) {
+
+            SortDecision decision;
+            decision.stats = sample_stats_epi32(array, lenArray);
+            decision.numThreads = threads_for_length(lenArray, maxThreads);
+
+            if (decision.stats.sortedness >= 0.999) {
+                decision.algorithm = SORT_ALREADY_SORTED;
+            } else if (decision.stats.reverseness >= 0.999) {
+                decision.algorithm = SORT_REVERSE;
+            } else {
+                chooseUnsortedSort(decision, true);
+            }
+
+            return decision;
+        }
+
+
+        /*
+         *  Entry point for sorting without knowing the input.
+         *  A sampled statistics pass chooses the implementation and the number of threads (see chooseSort).
+         *  The sample can be wrong, so sorted inputs are verified and the counting sort checks the exact range.
+         *  A wrong guess continues with the next candidates of chooseSort, not directly with the quicksort,
+         *  which is slow for few distinct values.
+         *
+         *  Params:
+         *  uint32_t*   array       -->     Array to sort
+         *  int         lenArray    -->     Number of values
+         *  int         maxThreads  -->     Upper limit for the number of threads
+         *
+         *  Returns:
+         *  SortDecision            -->     The implementation which sorted the array
+         *
+         */
+        SortDecision adaptiveSort(uint32_t* array, int lenArray, int maxThreads) {
+
+            SortDecision decision = chooseSort(array, lenArray, maxThreads);
+
+            if (lenArray < 2) {
+                decision.algorithm = SORT_ALREADY_SORTED;
+                return decision;
+            }
+
+            if (decision.algorithm == SORT_ALREADY_SORTED) {
+                if (is_sorted_epi32(array, lenArray)) {
+                    return decision;
+                }
+                chooseUnsortedSort(decision, true);
+            }
+
+            if (decision.algorithm == SORT_REVERSE) {
+                std::reverse(array, array + lenArray);
+                if (is_sorted_epi32(array, lenArray)) {
+                    return decision;
+                }
+                chooseUnsortedSort(decision, true);
+            }
+
+            if (decision.algorithm == SORT_COUNTING) {
+                uint32_t minValue;
+                uint32_t maxValue;
+                minmax_epi32(array, lenArray, minValue, maxValue);
+
+                // The sample may have missed the extremes, a range up to twice the length is still fine.
+                const long long range = (long long)maxValue - minValue + 1;
+                if (range <= 2 * (long long)lenArray && range * decision.numThreads <= COUNTING_MAX_ENTRIES) {
+                    ompCountingSort(array, lenArray, minValue, maxValue, decision.numThreads);
+                    return decision;
+                }
+                decision.numThreads = threads_for_length(lenArray, maxThreads);
+                chooseUnsortedSort(decision, false);
+            }
+
+            switch (decision.algorithm) {
+
+                case SORT_COUNT_EXPAND: {
+                    std::vector<uint32_t> unique(lenArray);
+                    std::vector<uint32_t> counts(lenArray);
+                    const int numUnique = ompSortCount(array, lenArray, unique.data(), counts.data(), decision.numThreads);
+                    int pos = 0;
+                    for (int u = 0; u < numUnique; u++) {
+                        std::fill(array + pos, array + pos + counts[u], unique[u]);
+                        pos += counts[u];
+                    }
+                    break;
+                }
+
+                case SORT_SIMD:
+                    quicksort(array, 0, lenArray - 1);
+                    break;
+
+                default:
+                    ompQuicksort(array, lenArray, decision.numThreads);
+                    break;
+            }
+
+            return decision;
+        }
+
+    } // namespace avx2
+
+} // namespace qs
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <queue>
+#include <vector>
+
+
+namespace qs {
+
+    namespace avx2 {
+
+
+        /*
+         *  Sorts data which arrives in batches.
+         *  Every pushed batch is copied into its own run and sorted asynchronously with the SIMD quicksort,
+         *  so the sorting work overlaps with the time spent waiting for the next batch.
+         *  The sorted runs are combined by finish() (parallel merge) or lazily by next() (k-way merge).
+         *
+         *  Usage:
+         *  IncrementalSorter sorter(numThreads);
+         *  sorter.push(batch, lenBatch);       -->     As often as needed
+         *  sorter.finish(array);               -->     array must hold size() elements
+         *
+         */
+        class IncrementalSorter {
+
+        public:
+
+            /*
+             *  Params:
+             *  int         numThreads  -->     Maximal number of batches sorted at once and threads used for merging
+             *
+             */
+            explicit IncrementalSorter(int numThreads) : numThreads(numThreads < 1 ? 1 : numThreads), length(0), merging(false), firstPending(0) {}
+
+            ~IncrementalSorter() {
+                wait();
+            }
+
+
+            /*
+             *  Copies a batch and starts sorting it on a worker thread.
+             *
+             *  Params:
+             *  uint32_t*   batch       -->     Values to add
+             *  int         lenBatch    -->     Number of values in batch
+             *
+             */
+            void push(const uint32_t* batch, int lenBatch) {
+
+                assert(!merging);
+
+                if (lenBatch <= 0) {
+                    return;
+                }
+
+                // Limit the number of concurrently sorted batches by waiting for the oldest one.
+                if ((int)pending.size() - (int)firstPending >= numThreads) {
+                    pending[firstPending++].wait();
+                }
+
+                runs.push_back(std::vector<uint32_t>(batch, batch + lenBatch));
+                length += lenBatch;
+
+                // The buffer of the inner vector does not move if runs reallocates.
+                uint32_t* run = runs.back().data();
+                pending.push_back(std::async(std::launch::async, [run, lenBatch]() {
+                    quicksort(run, 0, lenBatch - 1);
+                }));
+            }
+
+
+            // Number of values pushed so far.
+            int size() const {
+                return length;
+            }
+
+
+            /*
+             *  Waits for all batches and merges them into the given array.
+             *
+             *  Params:
+             *  uint32_t*   array       -->     Destination, must hold size() values
+             *
+             */
+            void finish(uint32_t* array) {
+
+                wait();
+
+                const int numRuns = (int)runs.size();
+                if (numRuns == 0) {
+                    return;
+                }
+
+                // Offsets of runs inside the destination array.
+                std::vector<const uint32_t*> sources(numRuns);
+                std::vector<int> bounds(numRuns + 1, 0);
+                for (int r = 0; r < numRuns; r++) {
+                    sources[r] = runs[r].data();
+                    bounds[r + 1] = bounds[r] + (int)runs[r].size();
+                }
+
+                parallel_merge_runs(sources, bounds, array, numThreads);
+            }
+
+
+            /*
+             *  Lazy sorted iteration: yields the values in ascending order without merging all runs first.
+             *  The smallest values are available as soon as every batch is sorted.
+             *
+             *  Params:
+             *  uint32_t    value       -->     Next smallest value
+             *
+             *  Returns:
+             *  bool                    -->     false if all values were yielded
+             *
+             */
+            bool next(uint32_t& value) {
+
+                if (!merging) {
+                    wait();
+                    merging = true;
+                    for (int r = 0; r < (int)runs.size(); r++) {
+                        heap.push(Cursor(runs[r][0], r, 0));
+                    }
+                }
+
+                if (heap.empty()) {
+                    return false;
+                }
+
+                const Cursor top = heap.top();
+                heap.pop();
+                value = top.value;
+
+                const int pos = top.pos + 1;
+                if (pos < (int)runs[top.run].size()) {
+                    heap.push(Cursor(runs[top.run][pos], top.run, pos));
+                }
+
+                return true;
+            }
+
+        private:
+
+            // Position inside a sorted run used by the lazy k-way merge.
+            struct Cursor {
+                uint32_t value;
+                int run;
+                int pos;
+
+                Cursor(uint32_t value, int run, int pos) : value(value), run(run), pos(pos) {}
+
+                bool operator>(const Cursor& other) const {
+                    return value > other.value;
+                }
+            };
+
+            // Blocks until every pushed batch is sorted.
+            void wait() {
+                for (; firstPending < pending.size(); firstPending++) {
+                    pending[firstPending].wait();
+                }
+            }
+
+            int numThreads;
+            int length;
+            bool merging;
+            size_t firstPending;
+
+            std::vector<std::vector<uint32_t> > runs;
+            std::vector<std::future<void> > pending;
+
+            std::priority_queue<Cursor, std::vector<Cursor>, std::greater<Cursor> > heap;
+        };
+
+    } // namespace avx2
+
+} // namespace qs
@@ -157,13 +157,15 @@ namespace qs {
             // the number of items in a register (256/32)
             const int N = 8; 
 
-            __m256i L;
-            __m256i R;
+            __m256i L = _mm256_setzero_si256();
+            __m256i R = _mm256_setzero_si256();
             uint8_t maskL = 0;
             uint8_t maskR = 0;
 
-            // Load pivot into integer vector
-            const __m256i pivot = _mm256_set1_epi32(pv);
+            // Load pivot into integer vector.
+            // Flipping the sign bit turns the signed compare into an unsigned one.
+            const __m256i sign  = _mm256_set1_epi32((int)0x80000000);
+            const __m256i pivot = _mm256_xor_si256(_mm256_set1_epi32(pv), sign);
 
             int origL = left;
             int origR = right;
@@ -184,7 +186,7 @@ namespace qs {
 
                         // Compares pivot with loaded values from array (L).
                         // Returns mask with 1 for pivot > L and 0 for pivot < L.
-                        const __m256i bytemask = _mm256_cmpgt_epi32(pivot, L);
+                        const __m256i bytemask = _mm256_cmpgt_epi32(pivot, _mm256_xor_si256(L, sign));
 
                         // Check if bytemask contains values greater than pivot
                         if (_mm256_testc_ps((__m256)bytemask, (__m256)_mm256_set1_epi32(-1))) {
@@ -213,7 +215,7 @@ namespace qs {
                         
                         // Compares pivot with loaded values from array (L).
                         // Returns mask with 1 for pivot > L and 0 for pivot < L.
-                        const __m256i bytemask = _mm256_cmpgt_epi32(pivot, R);
+                        const __m256i bytemask = _mm256_cmpgt_epi32(pivot, _mm256_xor_si256(R, sign));
 
                         // Check if bytemask contains values lower than pivot
                         if (_mm256_iszero(bytemask)) {
@@ -292,16 +294,171 @@ namespace qs {
 
                 if (all == less) {
                     // all elements in range [left, right] less than pivot
-                    scalar_partition_epi32(array, pv, origL, left);
-                } else if (all == greater) {
+                    left = right + 1;
+                } else if (all == greater && left > origL) {
                     // all elements in range [left, right] greater than pivot
-                    scalar_partition_epi32(array, pv, left, origR);
+                    right = left - 1;
+                } else if (all == greater) {
+                    // no element lower than pivot was found, the right side would not shrink
+                    right = origR;
+                    scalar_partition_epi32(array, pv, left, right);
                 } else {
                     scalar_partition_epi32(array, pv, left, right);
                 }
             }
         }
 
+
+
+        /*
+         *  SIMD Partition part for quicksort on keys with an attached index.
+         *  Works like partition_epi32, but every swap of keys is applied to the indices as well.
+         *  Keys are compared unsigned (the sign bit is flipped before the signed compare),
+         *  so the whole 32 bit range can be used.
+         *
+         *  Params:
+         *  uint32_t*   keys        -->     Keys to sort
+         *  uint32_t*   index       -->     Values moved along with the keys
+         *  uint32_t    pv          -->     Pivot element for comparison
+         *  int         left        -->     Lower index
+         *  int         right       -->     Higher index
+         *
+         */
+        void FORCE_INLINE partition_key_index_epi32(uint32_t* keys, uint32_t* index, uint32_t pv, int& left, int& right) {
+
+            // the number of items in a register (256/32)
+            const int N = 8;
+
+            __m256i L = _mm256_setzero_si256();
+            __m256i R = _mm256_setzero_si256();
+            __m256i LI = _mm256_setzero_si256();
+            __m256i RI = _mm256_setzero_si256();
+            uint8_t maskL = 0;
+            uint8_t maskR = 0;
+
+            // Flipping the sign bit turns the signed compare into an unsigned one.
+            const __m256i sign  = _mm256_set1_epi32((int)0x80000000);
+            const __m256i pivot = _mm256_xor_si256(_mm256_set1_epi32(pv), sign);
+
+            int origL = left;
+            int origR = right;
+
+            while (true) {
+
+                // Check left side for keys lower than pivot
+                if (maskL == 0) {
+                    while (true) {
+
+                        if (right - (left + N) + 1 < 2*N) {
+                            goto end;
+                        }
+
+                        L  = _mm256_loadu_si256((__m256i*)(keys + left));
+                        LI = _mm256_loadu_si256((__m256i*)(index + left));
+
+                        const __m256i bytemask = _mm256_cmpgt_epi32(pivot, _mm256_xor_si256(L, sign));
+
+                        if (_mm256_testc_ps((__m256)bytemask, (__m256)_mm256_set1_epi32(-1))) {
+                            left += N;
+                        } else {
+                            maskL = ~_mm256_movemask_ps((__m256)bytemask);
+                            break;
+                        }
+                    }
+
+                }
+
+                // Check right side for keys greater than pivot
+                if (maskR == 0) {
+                    while (true) {
+
+                        if ((right - N) - left + 1 < 2*N) {
+                            goto end;
+                        }
+
+                        R  = _mm256_loadu_si256((__m256i*)(keys + right - N + 1));
+                        RI = _mm256_loadu_si256((__m256i*)(index + right - N + 1));
+
+                        const __m256i bytemask = _mm256_cmpgt_epi32(pivot, _mm256_xor_si256(R, sign));
+
+                        if (_mm256_iszero(bytemask)) {
+                            right -= N;
+                        } else {
+                            maskR = _mm256_movemask_ps((__m256)bytemask);
+                            break;
+                        }
+                    }
+
+                }
+
+                assert(left <= right);
+                assert(maskL != 0);
+                assert(maskR != 0);
+
+                uint8_t mL;
+                uint8_t mR;
+                __m256i shuffleL;
+                __m256i shuffleR;
+
+                // Sync masks and swap keys and indices the same way
+                align_masks(maskL, maskR, mL, mR, shuffleL, shuffleR);
+                swap_epi32(L, R, maskL, shuffleL, maskR, shuffleR);
+                swap_epi32(LI, RI, maskL, shuffleL, maskR, shuffleR);
+
+                maskL = mL;
+                maskR = mR;
+
+                if (maskL == 0) {
+                    _mm256_storeu_si256((__m256i*)(keys + left), L);
+                    _mm256_storeu_si256((__m256i*)(index + left), LI);
+                    left += N;
+                }
+
+                if (maskR == 0) {
+                    _mm256_storeu_si256((__m256i*)(keys + right - N + 1), R);
+                    _mm256_storeu_si256((__m256i*)(index + right - N + 1), RI);
+                    right -= N;
+                }
+
+            } // while
+
+        // Called when while loop from above ends
+        end:
+
+            assert(!(maskL != 0 && maskR != 0));
+
+            if (maskL != 0) {
+                _mm256_storeu_si256((__m256i*)(keys + left), L);
+                _mm256_storeu_si256((__m256i*)(index + left), LI);
+            } else if (maskR != 0) {
+                _mm256_storeu_si256((__m256i*)(keys + right - N + 1), R);
+                _mm256_storeu_si256((__m256i*)(index + right - N + 1), RI);
+            }
+
+            // Remaining keys are compared without SIMD, see partition_epi32.
+            if (left < right) {
+                int less    = 0;
+                int greater = 0;
+                const int all = right - left + 1;
+
+                for (int i=left; i <= right; i++) {
+                    less    += int(keys[i] < pv);
+                    greater += int(keys[i] > pv);
+                }
+
+                if (all == less) {
+                    left = right + 1;
+                } else if (all == greater && left > origL) {
+                    right = left - 1;
+                } else if (all == greater) {
+                    right = origR;
+                    scalar_partition_key_index_epi32(keys, index, pv, left, right);
+                } else {
+                    scalar_partition_key_index_epi32(keys, index, pv, left, right);
+                }
+            }
+        }
+
     } // namespace avx2
 
 } // namespace qs
\ No newline at end of file
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "common.h"
 #include "avx2_partition.cpp"
 
@@ -15,7 +17,7 @@ namespace qs {
             * The closer the pivot is to the median, the less has to be swapped.
             * The calculation of the median is too expensive, so we use the mean value of left right and center of array. 
             */ 
-            const uint32_t pivot = (array[i] + array[(i + j) / 2] + array[j])/3;
+            const uint32_t pivot = (uint32_t)(((uint64_t)array[i] + array[(i + j) / 2] + array[j])/3);
 
             const int AVX2_REGISTER_SIZE = 8; // in 32-bit words
 
@@ -47,7 +49,7 @@ namespace qs {
             * The closer the pivot is to the median, the less has to be swapped.
             * The calculation of the median is too expensive, so we use the mean value of left right and center of array. 
             */ 
-            const uint32_t pivot = (array[i] + array[(i + j) / 2] + array[j])/3;
+            const uint32_t pivot = (uint32_t)(((uint64_t)array[i] + array[(i + j) / 2] + array[j])/3);
 
             const int AVX2_REGISTER_SIZE = 8; // in 32-bit words
 
@@ -94,6 +96,114 @@ namespace qs {
 
         }
 
+
+        /*
+         *  Moves all keys equal to value (and their indices) to the front of range [left, right].
+         *
+         *  Params:
+         *  uint32_t*   keys        -->     Keys
+         *  uint32_t*   index       -->     Optional (may be NULL), values moved along with the keys
+         *  uint32_t    value       -->     Value to move to the front
+         *  int         left        -->     Lower index
+         *  int         right       -->     Higher index
+         *
+         *  Returns:
+         *  int                     -->     First index behind the moved keys
+         *
+         */
+        int move_equal_to_front_epi32(uint32_t* keys, uint32_t* index, uint32_t value, int left, int right) {
+
+            int e = left;
+            for (int k = left; k <= right; k++) {
+                if (keys[k] == value) {
+                    std::swap(keys[k], keys[e]);
+                    if (index != NULL) {
+                        std::swap(index[k], index[e]);
+                    }
+                    e++;
+                }
+            }
+            return e;
+        }
+
+
+        /*
+         *  Keys equal to the pivot end on the right side of a partition. Long runs of equal keys would only
+         *  shrink by a few keys per partition, so if the right side is much bigger than the left one,
+         *  its keys equal to the pivot are moved to its front and left out, they are at their final position.
+         *
+         *  Params:
+         *  uint32_t*   keys        -->     Partitioned keys
+         *  uint32_t*   index       -->     Optional (may be NULL), values moved along with the keys
+         *  uint32_t    pivot       -->     Pivot of the partition
+         *  int         left        -->     Lower index of the left side
+         *  int         j           -->     Higher index of the left side
+         *  int         i           -->     Lower index of the right side
+         *  int         right       -->     Higher index of the right side
+         *
+         *  Returns:
+         *  int                     -->     New lower index of the right side
+         *
+         */
+        int skip_equal_to_pivot_epi32(uint32_t* keys, uint32_t* index, uint32_t pivot, int left, int j, int i, int right) {
+
+            if (right - i > 8 * (j - left)) {
+                return move_equal_to_front_epi32(keys, index, pivot, i, right);
+            }
+            return i;
+        }
+
+        // SIMD and OMP quicksort for keys with an attached index, has to be called inside a parallel region.
+        void ompQuicksortKeyIndexInternal(uint32_t* keys, uint32_t* index, int left, int right, int cutoff) {
+
+            int i = left;
+            int j = right;
+
+            /* Calculate pivot:
+            * Prefix keys are very skewed (e.g. padded short strings), the mean value would often split off only a few keys.
+            * So the median of left, right and center of array is used.
+            */
+            const uint32_t a = keys[i];
+            const uint32_t b = keys[(i + j) / 2];
+            const uint32_t c = keys[j];
+            const uint32_t pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+
+            const int AVX2_REGISTER_SIZE = 8; // in 32-bit words
+
+
+	        /* ------------------------- PARTITION PART ------------------------- */
+            if (j - i >= 2 * AVX2_REGISTER_SIZE) {
+                qs::avx2::partition_key_index_epi32(keys, index, pivot, i, j);
+            } else {
+                scalar_partition_key_index_epi32(keys, index, pivot, i, j);
+            }
+
+
+            /* ------------------------- RECURSION PART ------------------------- */
+            // Prefix keys contain long runs of equal keys.
+            i = skip_equal_to_pivot_epi32(keys, index, pivot, left, j, i, right);
+
+            if ( ((right-left)<cutoff) ){
+
+                // Sequential
+                if (left < j){ ompQuicksortKeyIndexInternal(keys, index, left, j, cutoff); }
+                if (i < right){ ompQuicksortKeyIndexInternal(keys, index, i, right, cutoff); }
+
+            } else {
+
+                // Parallel
+                if (left < j) {
+                    #pragma omp task
+                    { ompQuicksortKeyIndexInternal(keys, index, left, j, cutoff); }
+                }
+                if (i < right) {
+                    #pragma omp task
+                    { ompQuicksortKeyIndexInternal(keys, index, i, right, cutoff); }
+                }
+
+            }
+        }
+
     } // namespace avx2
 
 } // namespace qs
\ No newline at end of file
@@ -0,0 +1,469 @@
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+
+namespace qs {
+
+    namespace avx2 {
+
+
+        /*
+         *  Communication between the ranks of a distributed sort.
+         *  Implementations only have to provide a combined send and receive,
+         *  so a rank can exchange data with two different partners without deadlocking.
+         *
+         */
+        class Transport {
+
+        public:
+
+            virtual ~Transport() {}
+
+            // Index of this process in [0, size())
+            virtual int rank() const = 0;
+
+            // Number of processes taking part in the sort
+            virtual int size() const = 0;
+
+            /*
+             *  Sends a buffer to one rank while receiving a buffer from another (or the same) rank.
+             *  Blocks until both transfers are complete.
+             *
+             *  Params:
+             *  int         dest        -->     Receiving rank
+             *  void*       sendBuf     -->     Data to send
+             *  size_t      sendBytes   -->     Number of bytes to send
+             *  int         src         -->     Sending rank
+             *  void*       recvBuf     -->     Destination for received data
+             *  size_t      recvBytes   -->     Number of bytes to receive
+             *
+             *  Returns:
+             *  bool                    -->     false if the transfer failed
+             *
+             */
+            virtual bool sendrecv(int dest, const void* sendBuf, size_t sendBytes, int src, void* recvBuf, size_t recvBytes) = 0;
+        };
+
+
+        /*
+         *  Transport between processes on the same machine using a Unix socket pair for every pair of ranks.
+         *  Use runLocal() to start the ranks.
+         *
+         */
+        class LocalSocketTransport : public Transport {
+
+        public:
+
+            LocalSocketTransport(int myRank, const std::vector<int>& fds) : myRank(myRank), fds(fds) {}
+
+            ~LocalSocketTransport() {
+                for (int r = 0; r < (int)fds.size(); r++) {
+                    if (fds[r] >= 0) {
+                        close(fds[r]);
+                    }
+                }
+            }
+
+            int rank() const {
+                return myRank;
+            }
+
+            int size() const {
+                return (int)fds.size();
+            }
+
+            bool sendrecv(int dest, const void* sendBuf, size_t sendBytes, int src, void* recvBuf, size_t recvBytes) {
+
+                assert((dest == myRank) == (src == myRank));
+
+                // Data for the own rank is copied directly.
+                if (dest == myRank && src == myRank) {
+                    assert(sendBytes == recvBytes);
+                    if (sendBytes > 0) {
+                        memcpy(recvBuf, sendBuf, sendBytes);
+                    }
+                    return true;
+                }
+
+                const char* out = (const char*)sendBuf;
+                char* in = (char*)recvBuf;
+                size_t sent = 0;
+                size_t received = 0;
+
+                // Send and receive interleaved, otherwise two ranks sending large buffers to each other would block.
+                while (sent < sendBytes || received < recvBytes) {
+
+                    struct pollfd pfds[2];
+                    int numFds = 0;
+                    int outIdx = -1;
+                    int inIdx = -1;
+
+                    if (sent < sendBytes) {
+                        pfds[numFds].fd = fds[dest];
+                        pfds[numFds].events = POLLOUT;
+                        outIdx = numFds++;
+                    }
+
+                    if (received < recvBytes) {
+                        if (outIdx >= 0 && fds[src] == fds[dest]) {
+                            pfds[outIdx].events |= POLLIN;
+                            inIdx = outIdx;
+                        } else {
+                            pfds[numFds].fd = fds[src];
+                            pfds[numFds].events = POLLIN;
+                            inIdx = numFds++;
+                        }
+                    }
+
+                    if (poll(pfds, numFds, -1) < 0) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        perror("poll");
+                        return false;
+                    }
+
+                    if (outIdx >= 0 && (pfds[outIdx].revents & (POLLOUT | POLLERR | POLLHUP))) {
+                        const ssize_t n = send(fds[dest], out + sent, sendBytes - sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+                        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                            perror("send");
+                            return false;
+                        }
+                        sent += (n > 0) ? n : 0;
+                    }
+
+                    if (inIdx >= 0 && (pfds[inIdx].revents & (POLLIN | POLLERR | POLLHUP))) {
+                        const ssize_t n = recv(fds[src], in + received, recvBytes - received, MSG_DONTWAIT);
+                        if (n == 0) {
+                            fprintf(stderr, "recv: rank %d closed the connection\n", src);
+                            return false;
+                        }
+                        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                            perror("recv");
+                            return false;
+                        }
+                        received += (n > 0) ? n : 0;
+                    }
+                }
+
+                return true;
+            }
+
+        private:
+
+            int myRank;
+
+            // Socket connected to rank r, -1 for the own rank
+            std::vector<int> fds;
+        };
+
+
+        /*
+         *  Starts numRanks processes on this machine connected by a LocalSocketTransport and runs job in each.
+         *  The calling process becomes rank 0, the other ranks are forked children which exit after job.
+         *  libgomp is not fork safe: a child forked after the parent used OpenMP threads hangs in every
+         *  parallel region with more than one thread. So job gets numThreads on rank 0 and 1 on the children.
+         *
+         *  Params:
+         *  int         numRanks    -->     Number of processes
+         *  int         numThreads  -->     Threads rank 0 may use
+         *  function    job         -->     Work of a single rank, gets the transport and its number of threads
+         *
+         *  Returns:
+         *  bool                    -->     false if a rank could not be started or failed
+         *
+         */
+        bool runLocal(int numRanks, int numThreads, const std::function<bool(Transport&, int)>& job) {
+
+            assert(numRanks >= 1);
+
+            // sockets[a][b] is the end of the pair (a, b) owned by rank a.
+            std::vector<std::vector<int> > sockets(numRanks, std::vector<int>(numRanks, -1));
+            for (int a = 0; a < numRanks; a++) {
+                for (int b = a + 1; b < numRanks; b++) {
+                    int pair[2];
+                    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+                        perror("socketpair");
+                        for (int x = 0; x < numRanks; x++) {
+                            for (int y = 0; y < numRanks; y++) {
+                                if (sockets[x][y] >= 0) { close(sockets[x][y]); }
+                            }
+                        }
+                        return false;
+                    }
+                    sockets[a][b] = pair[0];
+                    sockets[b][a] = pair[1];
+                }
+            }
+
+            // Buffered output would be written twice otherwise.
+            fflush(stdout);
+            fflush(stderr);
+
+            std::vector<pid_t> children;
+            for (int r = 1; r < numRanks; r++) {
+
+                const pid_t pid = fork();
+
+                if (pid < 0) {
+                    perror("fork");
+                    break;
+                }
+
+                if (pid == 0) {
+                    // Child: keep only the own sockets.
+                    for (int a = 0; a < numRanks; a++) {
+                        if (a == r) { continue; }
+                        for (int b = 0; b < numRanks; b++) {
+                            if (sockets[a][b] >= 0) { close(sockets[a][b]); }
+                        }
+                    }
+
+                    bool success;
+                    {
+                        LocalSocketTransport transport(r, sockets[r]);
+                        success = job(transport, 1);
+                    }
+                    _exit(success ? 0 : 1);
+                }
+
+                children.push_back(pid);
+            }
+
+            for (int a = 1; a < numRanks; a++) {
+                for (int b = 0; b < numRanks; b++) {
+                    if (sockets[a][b] >= 0) { close(sockets[a][b]); }
+                }
+            }
+
+            bool success = (int)children.size() == numRanks - 1;
+
+            // Without all children the transport would block forever.
+            if (success) {
+                LocalSocketTransport transport(0, sockets[0]);
+                success = job(transport, numThreads);
+            } else {
+                for (int b = 0; b < numRanks; b++) {
+                    if (sockets[0][b] >= 0) { close(sockets[0][b]); }
+                }
+            }
+
+            for (int c = 0; c < (int)children.size(); c++) {
+                int status;
+                if (waitpid(children[c], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                    success = false;
+                }
+            }
+
+            return success;
+        }
+
+
+        /*
+         *  Personalized all-to-all exchange: every rank sends one buffer to every rank (including itself).
+         *  In step s rank r sends to rank r+s and receives from rank r-s, so every step is a permutation.
+         *
+         *  Params:
+         *  Transport&  transport   -->     Connection to the other ranks
+         *  uint32_t**  sendData    -->     sendData[r] is the buffer for rank r
+         *  int*        sendCounts  -->     sendCounts[r] is the number of values for rank r
+         *  vector      recv        -->     recv[r] is filled with the values from rank r
+         *
+         *  Returns:
+         *  bool                    -->     false if the transport failed
+         *
+         */
+        bool alltoall(Transport& transport, const std::vector<const uint32_t*>& sendData, const std::vector<int>& sendCounts,
+                      std::vector<std::vector<uint32_t> >& recv) {
+
+            const int numRanks = transport.size();
+            const int me = transport.rank();
+
+            assert((int)sendData.size() == numRanks);
+            assert((int)sendCounts.size() == numRanks);
+
+            std::vector<int> recvCounts(numRanks, 0);
+            recv.assign(numRanks, std::vector<uint32_t>());
+
+            // Sizes first, so every rank can allocate its receive buffers.
+            for (int s = 0; s < numRanks; s++) {
+                const int dest = (me + s) % numRanks;
+                const int src  = (me - s + numRanks) % numRanks;
+                if (!transport.sendrecv(dest, &sendCounts[dest], sizeof(int), src, &recvCounts[src], sizeof(int))) {
+                    return false;
+                }
+            }
+
+            for (int s = 0; s < numRanks; s++) {
+                const int dest = (me + s) % numRanks;
+                const int src  = (me - s + numRanks) % numRanks;
+                recv[src].resize(recvCounts[src]);
+                if (!transport.sendrecv(dest, sendData[dest], sendCounts[dest] * sizeof(uint32_t),
+                                        src, recv[src].data(), recvCounts[src] * sizeof(uint32_t))) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+
+        /*
+         *  Blocks until every rank reached the barrier (an all-to-all exchange without values).
+         *
+         *  Returns:
+         *  bool                    -->     false if the transport failed
+         *
+         */
+        bool barrier(Transport& transport) {
+
+            std::vector<std::vector<uint32_t> > recv;
+            return alltoall(transport, std::vector<const uint32_t*>(transport.size(), (const uint32_t*)NULL),
+                            std::vector<int>(transport.size(), 0), recv);
+        }
+
+
+        // Wall clock time in seconds spent in the phases of sampleSort() on one rank.
+        struct SampleSortTiming {
+            double localSort;
+            double wait;            // Waiting for the slowest local sort of all ranks
+            double sampling;
+            double exchange;
+            double merge;
+            int    numThreads;      // Threads of this rank, ranks started by runLocal() differ
+        };
+
+
+        /*
+         *  Distributed sample sort. Has to be called by every rank of the transport.
+         *  1. The local values are sorted with the SIMD and OMP quicksort.
+         *  2. Every rank draws regular samples, all samples are shared and the same splitters are chosen everywhere.
+         *  3. The local values are cut at the splitters and bucket r is sent to rank r.
+         *  4. The received sorted buckets are merged.
+         *  Afterwards the concatenation of result over all ranks in rank order is sorted.
+         *
+         *  Params:
+         *  Transport&  transport   -->     Connection to the other ranks
+         *  uint32_t*   array       -->     Local values, sorted in place during the local phase
+         *  int         lenArray    -->     Number of local values
+         *  int         numThreads  -->     Threads used for the local sort and the merge
+         *  vector      result      -->     Values of this rank after the sort
+         *  timing      timing      -->     Optional, receives the time of each phase
+         *
+         *  Returns:
+         *  bool                    -->     false if the transport failed
+         *
+         */
+        bool sampleSort(Transport& transport, uint32_t* array, int lenArray, int numThreads,
+                        std::vector<uint32_t>& result, SampleSortTiming* timing = NULL) {
+
+            // Samples per rank and splitter, more samples give more balanced buckets.
+            const int OVERSAMPLING = 32;
+
+            const int numRanks = transport.size();
+
+            SampleSortTiming t;
+            double startTime;
+
+
+            /* ------------------------- LOCAL SORT PART ------------------------- */
+            startTime = omp_get_wtime();
+            if (lenArray > 1) {
+                ompQuicksort(array, lenArray, numThreads);
+            }
+            t.localSort = omp_get_wtime() - startTime;
+            t.numThreads = numThreads;
+
+
+            /* ------------------------- WAIT PART ------------------------- */
+            // The ranks meet here first, otherwise the wait for the slowest rank would be counted as sampling.
+            startTime = omp_get_wtime();
+            if (!barrier(transport)) {
+                return false;
+            }
+            t.wait = omp_get_wtime() - startTime;
+
+
+            /* ------------------------- SAMPLING PART ------------------------- */
+            startTime = omp_get_wtime();
+
+            const int numSamples = std::min(lenArray, OVERSAMPLING * numRanks);
+            std::vector<uint32_t> samples(numSamples);
+            for (int s = 0; s < numSamples; s++) {
+                samples[s] = array[(int)(((long long)(2 * s + 1) * lenArray) / (2 * numSamples))];
+            }
+
+            std::vector<std::vector<uint32_t> > allSamples;
+            if (!alltoall(transport, std::vector<const uint32_t*>(numRanks, samples.data()), std::vector<int>(numRanks, numSamples), allSamples)) {
+                return false;
+            }
+
+            std::vector<uint32_t> pooled;
+            for (int r = 0; r < numRanks; r++) {
+                pooled.insert(pooled.end(), allSamples[r].begin(), allSamples[r].end());
+            }
+            std::sort(pooled.begin(), pooled.end());
+
+            // Bucket r gets the values in (splitters[r-1], splitters[r]].
+            std::vector<uint32_t> splitters(numRanks - 1);
+            for (int r = 1; r < numRanks; r++) {
+                splitters[r - 1] = pooled.empty() ? 0 : pooled[((long long)r * pooled.size()) / numRanks];
+            }
+
+            t.sampling = omp_get_wtime() - startTime;
+
+
+            /* ------------------------- EXCHANGE PART ------------------------- */
+            startTime = omp_get_wtime();
+
+            std::vector<const uint32_t*> sendData(numRanks);
+            std::vector<int> sendCounts(numRanks);
+            int lo = 0;
+            for (int r = 0; r < numRanks; r++) {
+                const int hi = (r == numRanks - 1) ? lenArray : (int)(std::upper_bound(array + lo, array + lenArray, splitters[r]) - array);
+                sendData[r] = array + lo;
+                sendCounts[r] = hi - lo;
+                lo = hi;
+            }
+
+            std::vector<std::vector<uint32_t> > buckets;
+            if (!alltoall(transport, sendData, sendCounts, buckets)) {
+                return false;
+            }
+
+            t.exchange = omp_get_wtime() - startTime;
+
+
+            /* ------------------------- MERGE PART ------------------------- */
+            startTime = omp_get_wtime();
+
+            std::vector<const uint32_t*> sources(numRanks);
+            std::vector<int> bounds(numRanks + 1, 0);
+            for (int r = 0; r < numRanks; r++) {
+                sources[r] = buckets[r].data();
+                bounds[r + 1] = bounds[r] + (int)buckets[r].size();
+            }
+
+            result.resize(bounds[numRanks]);
+            parallel_merge_runs(sources, bounds, result.data(), numThreads);
+
+            t.merge = omp_get_wtime() - startTime;
+
+            if (timing != NULL) {
+                *timing = t;
+            }
+
+            return true;
+        }
+
+    } // namespace avx2
+
+} // namespace qs
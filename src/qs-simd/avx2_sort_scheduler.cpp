@@ -0,0 +1,317 @@
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+
+namespace qs {
+
+    namespace avx2 {
+
+
+        enum SortStatus {
+            SORT_DONE,
+            SORT_CANCELLED
+        };
+
+
+        // Outcome of an asynchronous sort, times in seconds.
+        struct SortResult {
+            SortStatus  status;
+            double      queueLatency;       // From submission until the first task started
+            double      execLatency;        // From the first task until completion
+            bool        deadlineMissed;
+        };
+
+
+        // Per job settings of SortScheduler::submit.
+        struct SortOptions {
+            int         priority;           // Higher values run first
+            double      deadline;           // Seconds after submission, jobs with earlier deadlines run first (0 = none)
+            std::function<void(const SortResult&)> onComplete;     // Called on a worker thread when the job ends
+
+            SortOptions() : priority(0), deadline(0) {}
+        };
+
+
+        /*
+         *  Runs sorts asynchronously on a fixed set of worker threads.
+         *  Every job is split into tasks at partition boundaries and all tasks share one priority queue,
+         *  so a small urgent job does not wait for a large background job to finish, only for the partition
+         *  steps currently running. Cancellation is checked before every task.
+         *
+         *  Usage:
+         *  SortScheduler scheduler(numThreads);
+         *  SortScheduler::Handle handle = scheduler.submit(array, lenArray, options);
+         *  SortResult result = handle.result.get();
+         *
+         */
+        class SortScheduler {
+
+        private:
+
+            struct Job {
+                uint32_t*   array;
+                int         priority;
+                double      deadline;           // absolute (omp_get_wtime), infinity for none
+                long long   seq;
+                double      submitTime;
+                double      startTime;          // set by the first task, guarded by the queue mutex
+                bool        started;
+
+                std::atomic<bool>   cancelled;
+                std::atomic<bool>   skipped;    // a task was dropped, the array is not sorted
+                std::atomic<int>    pending;    // tasks queued or running
+
+                std::function<void(const SortResult&)> onComplete;
+                std::promise<SortResult> promise;
+            };
+
+            struct Task {
+                std::shared_ptr<Job> job;
+                int         left;
+                int         right;
+                long long   seq;
+
+                // Ordering of the queue: priority, deadline, older job, then newest task (depth first).
+                bool operator<(const Task& other) const {
+                    if (job->priority != other.job->priority) { return job->priority < other.job->priority; }
+                    if (job->deadline != other.job->deadline) { return job->deadline > other.job->deadline; }
+                    if (job->seq != other.job->seq)           { return job->seq > other.job->seq; }
+                    return seq < other.seq;
+                }
+            };
+
+        public:
+
+            // Returned by submit, the result becomes ready when the job is done or cancelled.
+            class Handle {
+
+            public:
+
+                std::shared_future<SortResult> result;
+
+                // Requests cancellation, takes effect at the next partition boundary.
+                void cancel() {
+                    if (job) {
+                        job->cancelled = true;
+                    }
+                }
+
+            private:
+
+                friend class SortScheduler;
+                std::shared_ptr<Job> job;
+            };
+
+
+            /*
+             *  Params:
+             *  int         numThreads  -->     Number of worker threads
+             *
+             */
+            explicit SortScheduler(int numThreads) : stopping(false), jobSeq(0), taskSeq(0) {
+                for (int t = 0; t < std::max(1, numThreads); t++) {
+                    workers.push_back(std::thread(&SortScheduler::work, this));
+                }
+            }
+
+            // Cancels all jobs which are not finished and waits for the workers.
+            // Running jobs stop at their next partition boundary, see work().
+            ~SortScheduler() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stopping = true;
+                }
+                available.notify_all();
+
+                for (int t = 0; t < (int)workers.size(); t++) {
+                    workers[t].join();
+                }
+            }
+
+
+            /*
+             *  Submits an array for sorting, returns immediately.
+             *  The array must stay valid and untouched until the result is ready,
+             *  a cancelled job leaves it partially sorted.
+             *
+             *  Params:
+             *  uint32_t*   array       -->     Array to sort
+             *  int         lenArray    -->     Number of values
+             *  SortOptions options     -->     Priority, deadline and completion callback
+             *
+             */
+            Handle submit(uint32_t* array, int lenArray, const SortOptions& options = SortOptions()) {
+
+                std::shared_ptr<Job> job = std::make_shared<Job>();
+                job->array       = array;
+                job->priority    = options.priority;
+                job->submitTime  = omp_get_wtime();
+                job->deadline    = options.deadline > 0 ? job->submitTime + options.deadline : std::numeric_limits<double>::infinity();
+                job->startTime   = 0;
+                job->started     = false;
+                job->cancelled   = false;
+                job->skipped     = false;
+                job->pending     = 1;
+                job->onComplete  = options.onComplete;
+
+                Handle handle;
+                handle.job = job;
+                handle.result = job->promise.get_future().share();
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    job->seq = jobSeq++;
+                    if (stopping) {
+                        job->cancelled = true;
+                    }
+                    push(job, 0, lenArray - 1);
+                }
+                available.notify_one();
+
+                return handle;
+            }
+
+        private:
+
+            // Has to be called with the mutex locked.
+            void push(const std::shared_ptr<Job>& job, int left, int right) {
+                Task task;
+                task.job   = job;
+                task.left  = left;
+                task.right = right;
+                task.seq   = taskSeq++;
+                queue.push(task);
+            }
+
+
+            void work() {
+
+                while (true) {
+
+                    Task task;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        available.wait(lock, [this]() { return stopping || !queue.empty(); });
+                        if (queue.empty()) {
+                            return;
+                        }
+                        task = queue.top();
+                        queue.pop();
+
+                        // Every task of a stopping scheduler is dropped, including the ones pushed by running tasks.
+                        if (stopping) {
+                            task.job->cancelled = true;
+                        }
+
+                        if (!task.job->started) {
+                            task.job->started = true;
+                            task.job->startTime = omp_get_wtime();
+                        }
+                    }
+
+                    if (task.job->cancelled) {
+                        task.job->skipped = true;
+                    } else {
+                        run(task);
+                    }
+
+                    if (--task.job->pending == 0) {
+                        finish(*task.job);
+                    }
+                }
+            }
+
+
+            // Sorts small ranges completely, larger ones are partitioned once and split into two tasks.
+            void run(const Task& task) {
+
+                // Largest range sorted without a cancellation check, a few milliseconds of work.
+                const int LEAF_SIZE = 1 << 16;
+
+                const int AVX2_REGISTER_SIZE = 8; // in 32-bit words
+
+                uint32_t* array = task.job->array;
+                const int left  = task.left;
+                const int right = task.right;
+
+                if (right - left < LEAF_SIZE) {
+                    if (left < right) {
+                        quicksort(array, left, right);
+                    }
+                    return;
+                }
+
+                int i = left;
+                int j = right;
+
+                const uint32_t pivot = (uint32_t)(((uint64_t)array[i] + array[(i + j) / 2] + array[j])/3);
+
+	            /* ------------------------- PARTITION PART ------------------------- */
+                if (j - i >= 2 * AVX2_REGISTER_SIZE) {
+                    qs::avx2::partition_epi32(array, pivot, i, j);
+                } else {
+                    scalar_partition_epi32(array, pivot, i, j);
+                }
+
+                /* ------------------------- RECURSION PART ------------------------- */
+                int added = 0;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (left < j) {
+                        task.job->pending++;
+                        push(task.job, left, j);
+                        added++;
+                    }
+                    if (i < right) {
+                        task.job->pending++;
+                        push(task.job, i, right);
+                        added++;
+                    }
+                }
+
+                for (int a = 0; a < added; a++) {
+                    available.notify_one();
+                }
+            }
+
+
+            void finish(Job& job) {
+
+                const double now = omp_get_wtime();
+
+                SortResult result;
+                // A cancellation after the last task started does not change the sorted array.
+                result.status         = job.skipped ? SORT_CANCELLED : SORT_DONE;
+                result.queueLatency   = (job.started ? job.startTime : now) - job.submitTime;
+                result.execLatency    = job.started ? now - job.startTime : 0;
+                result.deadlineMissed = now > job.deadline;
+
+                if (job.onComplete) {
+                    job.onComplete(result);
+                }
+
+                job.promise.set_value(result);
+            }
+
+
+            std::mutex mutex;
+            std::condition_variable available;
+            std::priority_queue<Task> queue;
+            std::vector<std::thread> workers;
+
+            bool stopping;
+            long long jobSeq;
+            long long taskSeq;
+        };
+
+    } // namespace avx2
+
+} // namespace qs
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <vector>
+
+
+namespace qs {
+
+    namespace avx2 {
+
+
+        /*
+         *  Strings stored in one arena without per string allocations.
+         *  String s consists of the bytes blob[offsets[s]] up to blob[offsets[s+1]-1],
+         *  so offsets holds numStrings+1 entries.
+         *
+         */
+        struct StringArena {
+            const char*     blob;
+            const uint32_t* offsets;
+            int             numStrings;
+        };
+
+
+        /*
+         *  Extracts the big endian prefix key of a string at the given depth.
+         *  Missing bytes behind the end of the string are filled with 0.
+         *
+         *  Params:
+         *  StringArena arena       -->     Strings
+         *  uint32_t    s           -->     Index of the string
+         *  int         depth       -->     Number of bytes already known to be equal
+         *
+         *  Returns:
+         *  uint32_t                -->     Bytes [depth, depth+4) of the string, first byte most significant
+         *
+         */
+        uint32_t FORCE_INLINE prefix_key(const StringArena& arena, uint32_t s, int depth) {
+
+            const unsigned char* str = (const unsigned char*)arena.blob + arena.offsets[s] + depth;
+            const int rest = (int)(arena.offsets[s + 1] - arena.offsets[s]) - depth;
+
+            if (rest >= 4) {
+                uint32_t key;
+                memcpy(&key, str, 4);
+                return __builtin_bswap32(key);
+            }
+
+            uint32_t key = 0;
+            for (int b = 0; b < 4; b++) {
+                key = (key << 8) | (b < rest ? str[b] : 0);
+            }
+            return key;
+        }
+
+
+        /*
+         *  Lexicographic comparison of two strings, which are known to be equal in the first depth bytes.
+         *
+         *  Returns:
+         *  bool                    -->     true if string a is lower than string b
+         *
+         */
+        bool FORCE_INLINE string_less(const StringArena& arena, uint32_t a, uint32_t b, int depth) {
+
+            const int lenA = (int)(arena.offsets[a + 1] - arena.offsets[a]) - depth;
+            const int lenB = (int)(arena.offsets[b + 1] - arena.offsets[b]) - depth;
+
+            const int cmp = memcmp(arena.blob + arena.offsets[a] + depth, arena.blob + arena.offsets[b] + depth, std::min(lenA, lenB));
+
+            return cmp < 0 || (cmp == 0 && lenA < lenB);
+        }
+
+
+        /*
+         *  Multikey quicksort on prefix keys. Sorts order[0..n) by the strings they point to,
+         *  all these strings are equal in their first depth bytes.
+         *
+         *  Params:
+         *  StringArena arena       -->     Strings
+         *  uint32_t*   order       -->     String indices to sort
+         *  uint32_t*   keys        -->     Scratch buffer with n entries
+         *  int         n           -->     Number of strings
+         *  int         depth       -->     Length of the common prefix
+         *  int         cutoff      -->     Minimal number of strings for a new task
+         *
+         */
+        void stringSortInternal(const StringArena& arena, uint32_t* order, uint32_t* keys, int n, int depth, int cutoff) {
+
+            // Few strings are compared directly, extracting keys does not pay off.
+            const int INSERTION_SORT_SIZE = 16;
+
+            if (n < INSERTION_SORT_SIZE) {
+                for (int i = 1; i < n; i++) {
+                    const uint32_t s = order[i];
+                    int j = i;
+                    while (j > 0 && string_less(arena, s, order[j - 1], depth)) {
+                        order[j] = order[j - 1];
+                        j--;
+                    }
+                    order[j] = s;
+                }
+                return;
+            }
+
+
+            /* ------------------------- KEY PART ------------------------- */
+            for (int i = 0; i < n; i++) {
+                keys[i] = prefix_key(arena, order[i], depth);
+            }
+
+            #pragma omp taskgroup
+            {
+                ompQuicksortKeyIndexInternal(keys, order, 0, n - 1, cutoff);
+            }
+
+
+            /* ------------------------- RECURSION PART ------------------------- */
+            // Only strings with equal keys need to look at the next prefix.
+            const int nextDepth = depth + 4;
+
+            int start = 0;
+            while (start < n) {
+
+                int end = start + 1;
+                while (end < n && keys[end] == keys[start]) {
+                    end++;
+                }
+
+                if (end - start > 1) {
+
+                    // Strings ending within this key are prefixes of the others, so they come first (shorter first).
+                    uint32_t* finished = std::partition(order + start, order + end, [&](uint32_t s) {
+                        return (int)(arena.offsets[s + 1] - arena.offsets[s]) <= nextDepth;
+                    });
+                    std::sort(order + start, finished, [&](uint32_t a, uint32_t b) {
+                        return arena.offsets[a + 1] - arena.offsets[a] < arena.offsets[b + 1] - arena.offsets[b];
+                    });
+
+                    uint32_t* subOrder = finished;
+                    uint32_t* subKeys  = keys + (finished - order);
+                    const int subN     = (int)(order + end - finished);
+
+                    if (subN < cutoff) {
+                        stringSortInternal(arena, subOrder, subKeys, subN, nextDepth, cutoff);
+                    } else {
+                        #pragma omp task
+                        { stringSortInternal(arena, subOrder, subKeys, subN, nextDepth, cutoff); }
+                    }
+                }
+
+                start = end;
+            }
+        }
+
+
+        /*
+         *  Entry point for sorting strings with SIMD and OMP.
+         *  Writes the indices of the strings in lexicographic (unsigned byte) order to order.
+         *  The strings are sorted by 4 byte prefix keys with the key/index quicksort,
+         *  ties are resolved by recursing on the next prefix within each run of equal keys.
+         *
+         *  Params:
+         *  StringArena arena       -->     Strings to sort
+         *  uint32_t*   order       -->     Destination for the sorted string indices, numStrings entries
+         *  int         numThreads  -->     Number of threads
+         *
+         */
+        void ompStringSort(const StringArena& arena, uint32_t* order, int numThreads) {
+
+            int cutoff = 1000;
+
+            const int n = arena.numStrings;
+            for (int i = 0; i < n; i++) {
+                order[i] = i;
+            }
+
+            std::vector<uint32_t> keys(n);
+
+            #pragma omp parallel num_threads(numThreads)
+            {
+                #pragma omp single nowait
+                {
+                    stringSortInternal(arena, order, keys.data(), n, 0, cutoff);
+                }
+            }
+
+        }
+
+    } // namespace avx2
+
+} // namespace qs
@@ -0,0 +1,313 @@
+#include <algorithm>
+#include <vector>
+
+
+namespace qs {
+
+    namespace avx2 {
+
+
+        /*
+         *  Permutations for left packing: row m moves the lanes whose bit is set in m to the front.
+         *
+         */
+        struct CompressTable {
+            uint32_t __attribute__((__aligned__(32))) idx[256][8];
+
+            CompressTable() {
+                for (int m = 0; m < 256; m++) {
+                    int n = 0;
+                    for (int b = 0; b < 8; b++) {
+                        if (m & (1 << b)) {
+                            idx[m][n++] = b;
+                        }
+                    }
+                    for (; n < 8; n++) {
+                        idx[m][n] = 0;
+                    }
+                }
+            }
+        };
+
+        const CompressTable compressTable;
+
+
+        /*
+         *  Removes duplicates from a sorted range with SIMD.
+         *  Every lane is compared with its predecessor, lanes starting a new value are packed to the front
+         *  with a permutation. The start positions of the values are packed the same way.
+         *
+         *  Params:
+         *  uint32_t*   array       -->     Sorted values, unique values are written to array[left..]
+         *  uint32_t*   starts      -->     Optional (may be NULL), receives the start index of every unique value
+         *  int         left        -->     Lower index
+         *  int         right       -->     Higher index
+         *
+         *  Returns:
+         *  int                     -->     Number of unique values
+         *
+         */
+        int unique_epi32(uint32_t* array, uint32_t* starts, int left, int right) {
+
+            // the number of items in a register (256/32)
+            const int N = 8;
+
+            if (left > right) {
+                return 0;
+            }
+
+            // The first value is always unique.
+            int out = left + 1;
+            if (starts != NULL) {
+                starts[left] = left;
+            }
+
+            uint32_t last = array[left];
+            int k = left + 1;
+
+            const __m256i rotate = _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6);
+            const __m256i lanes  = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+            // Stores write up to N lanes at out <= k, so they never reach values which are not loaded yet.
+            for (; k + N - 1 <= right; k += N) {
+
+                const __m256i v    = _mm256_loadu_si256((__m256i*)(array + k));
+                const __m256i prev = _mm256_blend_epi32(_mm256_permutevar8x32_epi32(v, rotate), _mm256_set1_epi32(last), 0x01);
+
+                const uint8_t mask = ~_mm256_movemask_ps((__m256)_mm256_cmpeq_epi32(v, prev));
+                const __m256i shuffle = _mm256_load_si256((__m256i*)compressTable.idx[mask]);
+
+                last = (uint32_t)_mm256_extract_epi32(v, 7);
+
+                _mm256_storeu_si256((__m256i*)(array + out), _mm256_permutevar8x32_epi32(v, shuffle));
+
+                if (starts != NULL) {
+                    const __m256i pos = _mm256_add_epi32(_mm256_set1_epi32(k), lanes);
+                    _mm256_storeu_si256((__m256i*)(starts + out), _mm256_permutevar8x32_epi32(pos, shuffle));
+                }
+
+                out += _mm_popcnt_u32(mask);
+            }
+
+            // Remaining values without SIMD
+            for (; k <= right; k++) {
+                if (array[k] != last) {
+                    last = array[k];
+                    array[out] = last;
+                    if (starts != NULL) {
+                        starts[out] = k;
+                    }
+                    out++;
+                }
+            }
+
+            return out - left;
+        }
+
+
+        // Unique values of a part of the array, stored at array[start..start+length) and counts[start..].
+        struct UniqueSegment {
+            int start;
+            int length;
+
+            bool operator<(const UniqueSegment& other) const {
+                return start < other.start;
+            }
+        };
+
+
+        /*
+         *  SIMD and OMP quicksort with deduplication in the leaves, has to be called inside a parallel region.
+         *  Ranges smaller than cutoff are sorted and deduplicated by the task reaching them.
+         *  Large ranges of values equal to the pivot are not sorted at all, they become a single value with its count.
+         *
+         *  Params:
+         *  uint32_t*   array       -->     Array to sort
+         *  uint32_t*   counts      -->     Optional (may be NULL), receives the counts at the positions of the unique values
+         *  int         left        -->     Lower index
+         *  int         right       -->     Higher index
+         *  int         cutoff      -->     Size of the leaves
+         *  vector      segments    -->     Collects the deduplicated parts
+         *
+         */
+        void ompSortUniqueInternal(uint32_t* array, uint32_t* counts, int left, int right, int cutoff, std::vector<UniqueSegment>& segments) {
+
+            /* ------------------------- LEAF PART ------------------------- */
+            if (right - left < cutoff) {
+
+                quicksort(array, left, right);
+
+                const int length = unique_epi32(array, counts, left, right);
+
+                // Counts are the distances between the start positions.
+                if (counts != NULL) {
+                    for (int u = left; u < left + length - 1; u++) {
+                        counts[u] = counts[u + 1] - counts[u];
+                    }
+                    counts[left + length - 1] = right + 1 - counts[left + length - 1];
+                }
+
+                const UniqueSegment segment = { left, length };
+                #pragma omp critical(qs_unique_segments)
+                segments.push_back(segment);
+
+                return;
+            }
+
+            int i = left;
+            int j = right;
+
+            /* Calculate pivot:
+            * The closer the pivot is to the median, the less has to be swapped.
+            * The calculation of the median is too expensive, so we use the mean value of left right and center of array.
+            */
+            const uint32_t pivot = (uint32_t)(((uint64_t)array[i] + array[(i + j) / 2] + array[j])/3);
+
+
+	        /* ------------------------- PARTITION PART ------------------------- */
+            qs::avx2::partition_epi32(array, pivot, i, j);
+
+
+            /* ------------------------- EQUAL RANGE PART ------------------------- */
+            // Values equal to the pivot end on the right side, many of them make the right side much bigger.
+            int equalStart = j + 1;
+            i = skip_equal_to_pivot_epi32(array, NULL, pivot, left, j, i, right);
+
+            // Everything between both sides equals the pivot: one unique value.
+            if (equalStart < i) {
+                array[equalStart] = pivot;
+                if (counts != NULL) {
+                    counts[equalStart] = i - equalStart;
+                }
+
+                const UniqueSegment segment = { equalStart, 1 };
+                #pragma omp critical(qs_unique_segments)
+                segments.push_back(segment);
+            }
+
+
+            /* ------------------------- RECURSION PART ------------------------- */
+            // segments is a reference, without shared every task would work on a copy.
+            // Single values are leaves as well, every value has to end in a segment.
+            if (left <= j) {
+                #pragma omp task shared(segments)
+                { ompSortUniqueInternal(array, counts, left, j, cutoff, segments); }
+            }
+            if (i <= right) {
+                #pragma omp task shared(segments)
+                { ompSortUniqueInternal(array, counts, i, right, cutoff, segments); }
+            }
+        }
+
+
+        /*
+         *  Sorts and deduplicates in one pass, counts are optional.
+         *  The segments are concatenated in parallel, a value split between two segments is merged.
+         *
+         */
+        int ompSortUniqueCount(uint32_t* array, int lenArray, uint32_t* unique, uint32_t* counts, int numThreads) {
+
+            if (lenArray <= 0) {
+                return 0;
+            }
+
+            int cutoff = 1000;
+
+            // Counts of the leaves are collected at the positions of their unique values.
+            std::vector<uint32_t> localCounts(counts != NULL ? lenArray : 0);
+            uint32_t* segmentCounts = (counts != NULL) ? localCounts.data() : NULL;
+
+            std::vector<UniqueSegment> segments;
+
+            #pragma omp parallel num_threads(numThreads)
+            {
+                #pragma omp single nowait
+                {
+                    #pragma omp taskgroup
+                    {
+                        ompSortUniqueInternal(array, segmentCounts, 0, lenArray-1, cutoff, segments);
+                    }
+                }
+            }
+
+            std::sort(segments.begin(), segments.end());
+
+            // Output position of every segment. If a segment starts with the last value of its predecessor,
+            // this value is skipped and its count is added afterwards.
+            const int numSegments = (int)segments.size();
+            std::vector<int> dest(numSegments);
+            std::vector<int> skip(numSegments, 0);
+            int total = 0;
+            uint32_t last = 0;
+
+            for (int s = 0; s < numSegments; s++) {
+                const UniqueSegment& seg = segments[s];
+                skip[s] = (total > 0 && array[seg.start] == last) ? 1 : 0;
+                dest[s] = total;
+                total += seg.length - skip[s];
+                last = array[seg.start + seg.length - 1];
+            }
+
+            #pragma omp parallel for num_threads(numThreads) schedule(dynamic, 1)
+            for (int s = 0; s < numSegments; s++) {
+                const UniqueSegment& seg = segments[s];
+                const int from = seg.start + skip[s];
+                const int to   = seg.start + seg.length;
+                std::copy(array + from, array + to, unique + dest[s]);
+                if (counts != NULL) {
+                    std::copy(segmentCounts + from, segmentCounts + to, counts + dest[s]);
+                }
+            }
+
+            // Counts of skipped values belong to the last value before the segment.
+            if (counts != NULL) {
+                for (int s = 0; s < numSegments; s++) {
+                    if (skip[s]) {
+                        counts[dest[s] - 1] += segmentCounts[segments[s].start];
+                    }
+                }
+            }
+
+            return total;
+        }
+
+
+        /*
+         *  Entry point for sorting with deduplication (SIMD and OMP).
+         *
+         *  Params:
+         *  uint32_t*   array       -->     Values, used as scratch space (content is undefined afterwards)
+         *  int         lenArray    -->     Number of values
+         *  uint32_t*   unique      -->     Destination for the sorted unique values, needs space for lenArray values
+         *  int         numThreads  -->     Number of threads
+         *
+         *  Returns:
+         *  int                     -->     Number of unique values
+         *
+         */
+        int ompSortUnique(uint32_t* array, int lenArray, uint32_t* unique, int numThreads) {
+            return ompSortUniqueCount(array, lenArray, unique, NULL, numThreads);
+        }
+
+
+        /*
+         *  Entry point for sorting with counting of equal values (SIMD and OMP).
+         *
+         *  Params:
+         *  uint32_t*   array       -->     Values, used as scratch space (content is undefined afterwards)
+         *  int         lenArray    -->     Number of values
+         *  uint32_t*   unique      -->     Destination for the sorted unique values, needs space for lenArray values
+         *  uint32_t*   counts      -->     Destination for the number of occurrences of every unique value
+         *  int         numThreads  -->     Number of threads
+         *
+         *  Returns:
+         *  int                     -->     Number of unique values
+         *
+         */
+        int ompSortCount(uint32_t* array, int lenArray, uint32_t* unique, uint32_t* counts, int numThreads) {
+            return ompSortUniqueCount(array, lenArray, unique, counts, numThreads);
+        }
+
+    } // namespace avx2
+
+} // namespace qs
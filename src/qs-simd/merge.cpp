@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <vector>
+
+
+/*
+ *  Co-rank of a merge: the number of values taken from a when the first k values of the
+ *  merge of a and b are written (values of a first on ties, like std::merge).
+ *
+ *  Params:
+ *  int         k           -->     Position in the merged output
+ *  uint32_t*   a           -->     First sorted range
+ *  int         lenA        -->     Length of a
+ *  uint32_t*   b           -->     Second sorted range
+ *  int         lenB        -->     Length of b
+ *
+ *  Returns:
+ *  int                     -->     Number of values from a in the first k values of the output
+ *
+ */
+int merge_co_rank(int k, const uint32_t* a, int lenA, const uint32_t* b, int lenB) {
+
+    int lo = std::max(0, k - lenB);
+    int hi = std::min(k, lenA);
+
+    while (true) {
+        const int i = lo + (hi - lo) / 2;
+        const int j = k - i;
+
+        if (i > 0 && j < lenB && a[i - 1] > b[j]) {
+            hi = i - 1;
+        } else if (j > 0 && i < lenA && b[j - 1] >= a[i]) {
+            lo = i + 1;
+        } else {
+            return i;
+        }
+    }
+}
+
+
+/*
+ *  Merges sorted runs into one sorted array.
+ *  Runs are merged pairwise in rounds. Every round splits its output into chunks of equal size
+ *  (merge path), so all threads work on every round, the last one included.
+ *  The rounds alternate between array and a buffer, the first round reads the runs directly.
+ *
+ *  Params:
+ *  std::vector runs        -->     Sorted runs, run r holds bounds[r+1]-bounds[r] values
+ *  std::vector bounds      -->     Offsets of the runs in the output, bounds.back() is the length
+ *  uint32_t*   array       -->     Destination, must not overlap the runs
+ *  int         numThreads  -->     Number of threads used for merging
+ *
+ */
+void parallel_merge_runs(const std::vector<const uint32_t*>& runs, const std::vector<int>& bounds, uint32_t* array, int numThreads) {
+
+    // Smallest chunk worth a binary search and a scheduling step.
+    const int MIN_CHUNK_SIZE = 1 << 14;
+
+    int numRuns = (int)runs.size();
+    if (numRuns == 0) {
+        return;
+    }
+
+    const int length = bounds[numRuns];
+
+    int rounds = 1;
+    for (int n = numRuns; n > 2; n = (n + 1) / 2) {
+        rounds++;
+    }
+
+    // The last round has to write into array.
+    std::vector<uint32_t> tmp(rounds > 1 ? length : 0);
+
+    std::vector<const uint32_t*> src(runs);
+    std::vector<int> srcBounds(bounds);
+
+    const int chunkSize = std::max(MIN_CHUNK_SIZE, length / (4 * std::max(1, numThreads)) + 1);
+
+    for (int round = 0; round < rounds; round++) {
+
+        uint32_t* dst = ((rounds - 1 - round) % 2 == 0) ? array : tmp.data();
+
+        // Chunks of the output: pair p merges runs 2p and 2p+1 into [start, start + lenA + lenB).
+        std::vector<int> chunkPair;
+        std::vector<int> chunkBegin;
+        for (int p = 0; 2 * p < numRuns; p++) {
+            const int start = srcBounds[2 * p];
+            const int end   = srcBounds[std::min(2 * p + 2, numRuns)];
+            for (int k = start; k < end; k += chunkSize) {
+                chunkPair.push_back(p);
+                chunkBegin.push_back(k);
+            }
+        }
+
+        const int numChunks = (int)chunkPair.size();
+
+        #pragma omp parallel for num_threads(numThreads) schedule(dynamic, 1)
+        for (int c = 0; c < numChunks; c++) {
+
+            const int p     = chunkPair[c];
+            const int start = srcBounds[2 * p];
+            const int mid   = srcBounds[std::min(2 * p + 1, numRuns)];
+            const int end   = srcBounds[std::min(2 * p + 2, numRuns)];
+
+            const uint32_t* a = src[2 * p];
+            const uint32_t* b = (2 * p + 1 < numRuns) ? src[2 * p + 1] : a;     // a run without partner is copied
+            const int lenA = mid - start;
+            const int lenB = end - mid;
+
+            const int k0 = chunkBegin[c] - start;
+            const int k1 = std::min(chunkBegin[c] + chunkSize, end) - start;
+            const int i0 = merge_co_rank(k0, a, lenA, b, lenB);
+            const int i1 = merge_co_rank(k1, a, lenA, b, lenB);
+
+            std::merge(a + i0, a + i1, b + (k0 - i0), b + (k1 - i1), dst + start + k0);
+        }
+
+        // The merged pairs are the runs of the next round.
+        std::vector<const uint32_t*> nextSrc;
+        std::vector<int> nextBounds;
+        for (int p = 0; 2 * p < numRuns; p++) {
+            nextSrc.push_back(dst + srcBounds[2 * p]);
+            nextBounds.push_back(srcBounds[2 * p]);
+        }
+        nextBounds.push_back(length);
+
+        src.swap(nextSrc);
+        srcBounds.swap(nextBounds);
+        numRuns = (int)src.size();
+    }
+}
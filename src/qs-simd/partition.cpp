@@ -35,3 +35,48 @@ void scalar_partition_epi32(uint32_t* array, const uint32_t pivot, int& left, in
     }
     
 }
+
+
+/*
+ *  Calculates the partition part in a scalar (serial) way for keys with an attached index.
+ *  Every swap of two keys swaps the corresponding indices as well.
+ *
+ *  Params:
+ *  uint32_t*   keys        -->     Keys to sort
+ *  uint32_t*   index       -->     Values moved along with the keys
+ *  uint32_t    pv          -->     Pivot element for comparison
+ *  int         left        -->     Lower index
+ *  int         right       -->     Higher index
+ *
+ */
+void scalar_partition_key_index_epi32(uint32_t* keys, uint32_t* index, const uint32_t pivot, int& left, int& right) {
+
+    // While left <= right
+    while (left <= right) {
+
+		// Serach on left side for a value > pivot
+        while (keys[left] < pivot) {
+            left += 1;
+        }
+
+		// Search on right side for a value < pivot
+        while (keys[right] > pivot) {
+            right -= 1;
+        }
+
+		// Swap keys and indices
+        if (left <= right) {
+            const uint32_t t = keys[left];
+            keys[left]       = keys[right];
+            keys[right]      = t;
+
+            const uint32_t u = index[left];
+            index[left]      = index[right];
+            index[right]     = u;
+
+            left  += 1;
+            right -= 1;
+        }
+    }
+
+}
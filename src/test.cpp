@@ -77,7 +77,7 @@ void singleTest (int length)
 	int maxNum = length;
 
 	double startTime, stopTime;
-	double qsortTime, serialTime, ompTime, simdTime, ompSimdTime;
+	double qsortTime, serialTime, ompTime, simdTime, ompSimdTime, incrementalTime, distributedTime, stringRefTime, stringTime, countTime, uniqueTime, adaptiveTime, scheduledTime;
 
 	uint32_t* arr1;			// Default
 	uint32_t* arr2;  		// std::sort
@@ -231,6 +231,406 @@ void singleTest (int length)
 
 
 
+	// -------------------------------------------------------------------------------------- //
+	//                              	 incremental quicksort						 		  //
+	// -------------------------------------------------------------------------------------- //
+
+	// Batches are pushed one after another, as if they arrive over time.
+	const int numBatches = 16;
+	const int lenBatch = (length + numBatches - 1) / numBatches;
+
+	// Sort
+	startTime = omp_get_wtime();
+	{
+		::qs::avx2::IncrementalSorter sorter(numthreads);
+		for (int b = 0; b < length; b += lenBatch) {
+			sorter.push(arr1 + b, (b + lenBatch < length) ? lenBatch : length - b);
+		}
+		sorter.finish(arr3);
+	}
+	stopTime = omp_get_wtime();
+
+	printArray(length, arr3);
+
+	// Validate results
+	if(!compareArrays(length, arr2, arr3))
+	{
+		printf("The result with 'incremental QuickSort' is ¡¡INCORRECT!!\n");
+	}
+
+	// Validate lazy iteration
+	{
+		::qs::avx2::IncrementalSorter sorter(numthreads);
+		for (int b = 0; b < length; b += lenBatch) {
+			sorter.push(arr1 + b, (b + lenBatch < length) ? lenBatch : length - b);
+		}
+		uint32_t value;
+		int count = 0;
+		bool correctResult = true;
+		while (sorter.next(value)) {
+			if (count >= length || value != arr2[count]) { correctResult = false; }
+			count++;
+		}
+		if (!correctResult || count != length)
+		{
+			printf("The result with 'incremental QuickSort (lazy)' is ¡¡INCORRECT!!\n");
+		}
+	}
+
+	// Calculate and print time
+	incrementalTime = (stopTime-startTime);
+	printf("Incremental:     %f s\t%f\n", incrementalTime, (1/(incrementalTime/qsortTime)));
+
+
+
+	// -------------------------------------------------------------------------------------- //
+	//                              	 distributed sample sort						 	  //
+	// -------------------------------------------------------------------------------------- //
+
+	// Every rank is a process on this machine and owns a contiguous part of the input.
+	const int numRanks = 4;
+	::qs::avx2::SampleSortTiming timing;
+
+	// Sort
+	startTime = omp_get_wtime();
+	bool distributedSuccess = ::qs::avx2::runLocal(numRanks, numthreads, [&](::qs::avx2::Transport& transport, int rankThreads) {
+
+		const int rank = transport.rank();
+		const int lo = (int)(((long long)rank * length) / numRanks);
+		const int hi = (int)(((long long)(rank + 1) * length) / numRanks);
+		std::vector<uint32_t> local(arr1 + lo, arr1 + hi);
+		std::vector<uint32_t> result;
+
+		if (!::qs::avx2::sampleSort(transport, local.data(), hi - lo, rankThreads, result, &timing)) {
+			return false;
+		}
+
+		// Gather all results on rank 0 (this process).
+		std::vector<const uint32_t*> sendData(numRanks, result.data());
+		std::vector<int> sendCounts(numRanks, 0);
+		sendCounts[0] = (int)result.size();
+		std::vector<std::vector<uint32_t> > gathered;
+		if (!::qs::avx2::alltoall(transport, sendData, sendCounts, gathered)) {
+			return false;
+		}
+
+		if (rank == 0) {
+			int pos = 0;
+			for (int r = 0; r < numRanks; r++) {
+				for (int k = 0; k < (int)gathered[r].size() && pos < length; k++) {
+					arr3[pos++] = gathered[r][k];
+				}
+			}
+		}
+		return true;
+	});
+	stopTime = omp_get_wtime();
+
+	printArray(length, arr3);
+
+	// Validate results
+	if(!distributedSuccess || !compareArrays(length, arr2, arr3))
+	{
+		printf("The result with 'distributed sample sort' is ¡¡INCORRECT!!\n");
+	}
+
+	// Calculate and print time
+	distributedTime = (stopTime-startTime);
+	printf("Distributed:     %f s\t%f\n", distributedTime, (1/(distributedTime/qsortTime)));
+	// Forked ranks run with 1 thread (see runLocal), so rank 0 usually waits for them.
+	printf("  rank 0:        local sort %f s, wait %f s, sampling %f s, exchange %f s, merge %f s (%d threads, other ranks 1)\n",
+		timing.localSort, timing.wait, timing.sampling, timing.exchange, timing.merge, timing.numThreads);
+
+
+
+	// -------------------------------------------------------------------------------------- //
+	//                              	 	 string sort							 		  //
+	// -------------------------------------------------------------------------------------- //
+
+	// URL like strings with a long common prefix, limited in number to keep the memory small.
+	const int numStrings = (length < 1000000) ? length : 1000000;
+	std::vector<char> blob;
+	std::vector<uint32_t> offsets(1, 0);
+	for (int k = 0; k < numStrings; k++) {
+		char str[64];
+		const int len = snprintf(str, sizeof(str), "https://example.org/id/%u", arr1[k]);
+		blob.insert(blob.end(), str, str + len);
+		offsets.push_back((uint32_t)blob.size());
+	}
+	::qs::avx2::StringArena arena = { blob.data(), offsets.data(), numStrings };
+
+	std::vector<uint32_t> stringOrder(numStrings);
+	std::vector<uint32_t> refOrder(numStrings);
+	for (int k = 0; k < numStrings; k++) {
+		refOrder[k] = k;
+	}
+
+	// Reference
+	startTime = omp_get_wtime();
+	std::sort(refOrder.begin(), refOrder.end(), [&](uint32_t a, uint32_t b) {
+		return ::qs::avx2::string_less(arena, a, b, 0);
+	});
+	stopTime = omp_get_wtime();
+	stringRefTime = (stopTime-startTime);
+
+	// Sort
+	startTime = omp_get_wtime();
+	::qs::avx2::ompStringSort(arena, stringOrder.data(), numthreads);
+	stopTime = omp_get_wtime();
+
+	// Validate results, equal strings may appear in any order
+	bool stringsCorrect = true;
+	for (int k = 0; k < numStrings && stringsCorrect; k++) {
+		const uint32_t a = stringOrder[k];
+		const uint32_t b = refOrder[k];
+		stringsCorrect = (offsets[a + 1] - offsets[a] == offsets[b + 1] - offsets[b])
+			&& memcmp(&blob[offsets[a]], &blob[offsets[b]], offsets[a + 1] - offsets[a]) == 0;
+	}
+	if(!stringsCorrect)
+	{
+		printf("The result with 'string sort' is ¡¡INCORRECT!!\n");
+	}
+
+	// Calculate and print time (relative to std::sort on the strings)
+	stringTime = (stopTime-startTime);
+	printf("Strings (%3.0E): %f s\t%f\n", (double)numStrings, stringTime, (1/(stringTime/stringRefTime)));
+
+
+
+	// -------------------------------------------------------------------------------------- //
+	//                              	 sort with counting							 		  //
+	// -------------------------------------------------------------------------------------- //
+
+	// Reset Array
+	for (int i = 0; i<length;i++) {
+		arr3[i] = arr1[i];
+	}
+
+	uint32_t* uniqueValues = (uint32_t*) malloc(length*sizeof(uint32_t));
+	uint32_t* uniqueCounts = (uint32_t*) malloc(length*sizeof(uint32_t));
+
+	// Sort
+	startTime = omp_get_wtime();
+	int numUnique = ::qs::avx2::ompSortCount(arr3, length, uniqueValues, uniqueCounts, numthreads);
+	stopTime = omp_get_wtime();
+
+	printArray(numUnique, uniqueValues);
+
+	// Validate results against the sorted reference
+	{
+		bool correctResult = true;
+		int u = -1;
+		for (int k = 0; k < length && correctResult; k++) {
+			if (k == 0 || arr2[k] != arr2[k-1]) {
+				u++;
+				correctResult = (u < numUnique) && (uniqueValues[u] == arr2[k]) && (uniqueCounts[u] > 0);
+			}
+			if (correctResult) { uniqueCounts[u]--; }
+		}
+		for (int k = 0; k < numUnique && correctResult; k++) {
+			correctResult = (uniqueCounts[k] == 0);
+		}
+		if (!correctResult || u + 1 != numUnique)
+		{
+			printf("The result with 'sort count' is ¡¡INCORRECT!!\n");
+		}
+	}
+
+	// Calculate and print time
+	countTime = (stopTime-startTime);
+	printf("Sort & count:    %f s\t%f\n", countTime, (1/(countTime/qsortTime)));
+
+	// Reset Array
+	for (int i = 0; i<length;i++) {
+		arr3[i] = arr1[i];
+	}
+
+	// Sort
+	startTime = omp_get_wtime();
+	int numUnique2 = ::qs::avx2::ompSortUnique(arr3, length, uniqueValues, numthreads);
+	stopTime = omp_get_wtime();
+
+	// Validate results against the sorted reference
+	{
+		bool correctResult = (numUnique2 == numUnique);
+		int u = -1;
+		for (int k = 0; k < length && correctResult; k++) {
+			if (k == 0 || arr2[k] != arr2[k-1]) {
+				u++;
+				correctResult = (u < numUnique2) && (uniqueValues[u] == arr2[k]);
+			}
+		}
+		if (!correctResult)
+		{
+			printf("The result with 'sort unique' is ¡¡INCORRECT!!\n");
+		}
+	}
+
+	// Calculate and print time
+	uniqueTime = (stopTime-startTime);
+	printf("Sort & unique:   %f s\t%f\n", uniqueTime, (1/(uniqueTime/qsortTime)));
+
+	free(uniqueValues);
+	free(uniqueCounts);
+
+
+
+	// -------------------------------------------------------------------------------------- //
+	//                              	 	adaptive sort							 		  //
+	// -------------------------------------------------------------------------------------- //
+
+	// Reset Array
+	for (int i = 0; i<length;i++) {
+		arr3[i] = arr1[i];
+	}
+
+	// Sort
+	startTime = omp_get_wtime();
+	::qs::avx2::SortDecision decision = ::qs::avx2::adaptiveSort(arr3, length, numthreads);
+	stopTime = omp_get_wtime();
+
+	printArray(length, arr3);
+
+	// Validate results
+	if(!compareArrays(length, arr2, arr3))
+	{
+		printf("The result with 'adaptive sort' is ¡¡INCORRECT!!\n");
+	}
+
+	// Already sorted input has to be detected
+	if(::qs::avx2::adaptiveSort(arr3, length, numthreads).algorithm != ::qs::avx2::SORT_ALREADY_SORTED
+		|| !compareArrays(length, arr2, arr3))
+	{
+		printf("The result with 'adaptive sort' on sorted input is ¡¡INCORRECT!!\n");
+	}
+
+	// Few distinct values in long runs look sorted in the sample, the quicksort must not be the fallback.
+	// Runs of 1000 values alternate between two values / all 7 with a random value every 1000 values.
+	for (int pattern = 0; pattern < 2; pattern++) {
+		for (int i = 0; i<length;i++) {
+			if (pattern == 0) {
+				arr3[i] = ((i / 1000) % 2 == 0) ? 5 : 3000000000u;
+			} else {
+				arr3[i] = (i % 1000 == 999) ? 7 + arr1[i] : 7;
+			}
+		}
+		std::vector<uint32_t> runsRef(arr3, arr3 + length);
+		std::sort(runsRef.begin(), runsRef.end());
+
+		::qs::avx2::SortDecision runsDecision = ::qs::avx2::adaptiveSort(arr3, length, numthreads);
+
+		if(!compareArrays(length, runsRef.data(), arr3)
+			|| (length >= 100000 && (runsDecision.algorithm == ::qs::avx2::SORT_SIMD || runsDecision.algorithm == ::qs::avx2::SORT_SIMD_OMP)))
+		{
+			printf("The result with 'adaptive sort' on runs of equal values is ¡¡INCORRECT!! (%s)\n",
+				::qs::avx2::sortAlgorithmName(runsDecision.algorithm));
+		}
+	}
+
+	// Calculate and print time
+	adaptiveTime = (stopTime-startTime);
+	printf("Adaptive:        %f s\t%f\t(%s, %d threads)\n", adaptiveTime, (1/(adaptiveTime/qsortTime)),
+		::qs::avx2::sortAlgorithmName(decision.algorithm), decision.numThreads);
+
+
+
+	// -------------------------------------------------------------------------------------- //
+	//                              	 	scheduled sort							 		  //
+	// -------------------------------------------------------------------------------------- //
+
+	// Reset Array
+	for (int i = 0; i<length;i++) {
+		arr3[i] = arr1[i];
+	}
+
+	// An urgent small sort is submitted behind a large background sort, a third sort is cancelled.
+	const int urgentLength = length < 10000 ? length : 10000;
+	uint32_t* urgentArr = (uint32_t*)malloc(urgentLength*sizeof(uint32_t));
+	uint32_t* cancelArr = (uint32_t*)malloc(length*sizeof(uint32_t));
+	for (int i = 0; i<urgentLength;i++) {
+		urgentArr[i] = arr1[i];
+	}
+	for (int i = 0; i<length;i++) {
+		cancelArr[i] = arr1[i];
+	}
+
+	std::atomic<int> callbacks(0);
+	::qs::avx2::SortOptions background;
+	background.onComplete = [&callbacks](const ::qs::avx2::SortResult&) { callbacks++; };
+	::qs::avx2::SortOptions urgent = background;
+	urgent.priority = 1;
+	urgent.deadline = 0.01;
+
+	::qs::avx2::SortResult backgroundResult, urgentResult, cancelResult;
+	{
+		::qs::avx2::SortScheduler scheduler(numthreads);
+
+		// Sort
+		startTime = omp_get_wtime();
+		::qs::avx2::SortScheduler::Handle backgroundHandle = scheduler.submit(arr3, length, background);
+		::qs::avx2::SortScheduler::Handle cancelHandle = scheduler.submit(cancelArr, length, background);
+		::qs::avx2::SortScheduler::Handle urgentHandle = scheduler.submit(urgentArr, urgentLength, urgent);
+		cancelHandle.cancel();
+		backgroundResult = backgroundHandle.result.get();
+		stopTime = omp_get_wtime();
+
+		urgentResult = urgentHandle.result.get();
+		cancelResult = cancelHandle.result.get();
+	}
+
+	printArray(length, arr3);
+
+	// Validate results
+	if(backgroundResult.status != ::qs::avx2::SORT_DONE || !compareArrays(length, arr2, arr3))
+	{
+		printf("The result with 'scheduled sort' is ¡¡INCORRECT!!\n");
+	}
+	if(urgentResult.status != ::qs::avx2::SORT_DONE || !std::is_sorted(urgentArr, urgentArr + urgentLength))
+	{
+		printf("The result with 'scheduled sort' of the urgent job is ¡¡INCORRECT!!\n");
+	}
+	// Cancellation may come too late for small arrays, then the array has to be sorted.
+	// A cancelled job stopped before sorting everything, a single value is sorted anyway.
+	if((cancelResult.status == ::qs::avx2::SORT_DONE && !compareArrays(length, arr2, cancelArr))
+		|| (cancelResult.status == ::qs::avx2::SORT_CANCELLED && length >= 10000 && compareArrays(length, arr2, cancelArr)))
+	{
+		printf("The result with 'scheduled sort' of the cancelled job is ¡¡INCORRECT!!\n");
+	}
+	if(callbacks != 3)
+	{
+		printf("The callbacks of 'scheduled sort' are ¡¡INCORRECT!!\n");
+	}
+
+	// Calculate and print time
+	scheduledTime = (stopTime-startTime);
+	printf("Scheduled:       %f s\t%f\t(urgent queue %f s, exec %f s, %s)\n", scheduledTime, (1/(scheduledTime/qsortTime)),
+		urgentResult.queueLatency, urgentResult.execLatency, cancelResult.status == ::qs::avx2::SORT_CANCELLED ? "cancelled" : "not cancelled");
+
+	// A scheduler destroyed in the middle of a sort has to cancel it.
+	if(length >= 1000000)
+	{
+		for (int i = 0; i<length;i++) {
+			cancelArr[i] = arr1[i];
+		}
+
+		std::shared_future< ::qs::avx2::SortResult > stoppedResult;
+		{
+			::qs::avx2::SortScheduler scheduler(numthreads);
+			stoppedResult = scheduler.submit(cancelArr, length).result;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		if(stoppedResult.get().status != ::qs::avx2::SORT_CANCELLED)
+		{
+			printf("The result with 'scheduled sort' of a destroyed scheduler is ¡¡INCORRECT!!\n");
+		}
+	}
+
+	free(urgentArr);
+	free(cancelArr);
+
+
+
 	// -------------------------------------------------------------------------------------- //
 	//                        	 	Outputs ans deallocation					 			  //
 	// -------------------------------------------------------------------------------------- //
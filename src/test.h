@@ -13,5 +13,12 @@
 #include <sys/time.h>
 
 #include "qs-simd/partition.cpp"
+#include "qs-simd/merge.cpp"
 #include "parallel-quicksort.h"
-#include "qs-simd/avx2_quicksort.cpp"
\ No newline at end of file
+#include "qs-simd/avx2_quicksort.cpp"
+#include "qs-simd/avx2_incremental_sort.cpp"
+#include "qs-simd/avx2_sample_sort.cpp"
+#include "qs-simd/avx2_string_sort.cpp"
+#include "qs-simd/avx2_unique.cpp"
+#include "qs-simd/avx2_adaptive_sort.cpp"
+#include "qs-simd/avx2_sort_scheduler.cpp"
\ No newline at end of file